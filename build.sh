@@ -15,10 +15,10 @@ MODE=${1:-release}  # Default to release if no argument
 
 if [ "$MODE" == "debug" ]; then
     echo "[*] Building in DEBUG mode..."
-    CXXFLAGS="-std=c++20 -Wall -Wextra -pedantic -g -fsanitize=address -DDEBUG"
+    CXXFLAGS="-std=c++20 -Wall -Wextra -pedantic -g -fsanitize=address -DDEBUG -pthread"
 elif [ "$MODE" == "release" ]; then
     echo "[*] Building in RELEASE mode..."
-    CXXFLAGS="-std=c++20 -Wall -Wextra -pedantic -O2"
+    CXXFLAGS="-std=c++20 -Wall -Wextra -pedantic -O2 -pthread"
 else
     echo "[!] Unknown build mode: $MODE"
     echo "Usage: ./build.sh [debug|release]"
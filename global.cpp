@@ -1,11 +1,177 @@
 #include "headers/global.hpp" // all STL headers used in source file are included in their respective headers
 #include "headers/util.hpp"
 
-MountedDiskClass::MountedDiskClass()
+TraceRecorderClass::TraceRecorderClass(const std::string& trace_filename)
 {
-    this->filename = "floppy.disk"; // assigns the name at runtime
+    TraceFile = std::ofstream(trace_filename, std::ios::binary | std::ios::trunc);
 
-    DiskFile = std::fstream(this->filename, std::ios::binary | std::ios::out | std::ios::in);
+    if(!TraceFile.is_open())
+    {
+        throw std::runtime_error("TraceRecorderClass error: Could not create trace file\n");
+    }
+
+    TraceFileHeader header{TRACE_MAGIC, TRACE_VERSION, 0};
+    TraceFile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    if(TraceFile.fail())
+    {
+        throw std::runtime_error("TraceRecorderClass error: Trace header write failed\n");
+    }
+
+    start_time = std::chrono::steady_clock::now();
+
+    if(DEBUG_FLAG){std::cout << "DEBUG: tracing to " << trace_filename << "\n";}
+}
+
+TraceRecorderClass::~TraceRecorderClass()
+{
+    TraceFile.flush();
+    TraceFile.close();
+
+    if(TraceFile.fail())
+    {
+        std::cerr << "TraceRecorderClass error: Trace file may not have been written completely\n";
+    }
+}
+
+std::uint64_t TraceRecorderClass::Now() const
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_time).count();
+}
+
+void TraceRecorderClass::Record(std::uint8_t operation, std::uint64_t start_ns, std::uint64_t block_number, std::uint32_t size, const std::string& command_name)
+{
+    thread_local std::uint8_t thread_id = next_thread_id++; // assigned on the first record from each thread
+
+    TraceRecord record{start_ns, Now() - start_ns, block_number, size, static_cast<std::uint16_t>(command_name.size()), operation, thread_id};
+
+    std::lock_guard<std::mutex> lock(TraceMutex); // the records of one operation must not interleave with another's
+
+    TraceFile.write(reinterpret_cast<const char*>(&record), sizeof(record));
+    TraceFile.write(command_name.data(), record.name_length);
+}
+
+std::unique_ptr<TraceRecorderClass> Tracer;
+
+bool BlockCacheClass::Lookup(std::uint64_t block_number, Block& out_block)
+{
+    auto entry = entries.find(block_number);
+
+    if(entry == entries.end())
+    {
+        ++misses;
+        return false;
+    }
+
+    ++hits;
+    std::memcpy(&out_block, &entry->second, sizeof(out_block));
+    return true;
+}
+
+bool BlockCacheClass::Contains(std::uint64_t block_number) const
+{
+    return entries.find(block_number) != entries.end();
+}
+
+void BlockCacheClass::Insert(std::uint64_t block_number, const Block& in_block)
+{
+    if(entries.find(block_number) == entries.end())
+    {
+        if(entries.size() >= BLOCK_CACHE_CAPACITY) // FIFO is enough here, prefetched blocks are read once and in order
+        {
+            entries.erase(insertion_order.front());
+            insertion_order.pop_front();
+        }
+
+        insertion_order.push_back(block_number);
+    }
+
+    std::memcpy(&entries[block_number], &in_block, sizeof(in_block));
+}
+
+ReadaheadRequest ReadaheadClass::OnAccess(std::uint64_t block_number)
+{
+    ++tick;
+
+    StreamState* matched_stream = nullptr;
+
+    for(StreamState& stream : streams) // first pass: a stream expecting exactly this block
+    {
+        if(stream.next_block == block_number && (!matched_stream || stream.window > matched_stream->window))
+        {
+            matched_stream = &stream; // a new stream can catch up to a live one, so the one with the bigger window wins
+        }
+    }
+
+    if(matched_stream)
+    {
+        StreamState& stream = *matched_stream;
+
+        stream.next_block = block_number + 1;
+        stream.last_used = tick;
+
+        if(stream.window == 0) // second in-order read on this stream, so it's sequential. Start prefetching
+        {
+            stream.window = READAHEAD_INITIAL_WINDOW;
+        }
+
+        else if(block_number + stream.window / 2 < stream.readahead_end) // still well inside the prefetched range
+        {
+            return {0, 0};
+        }
+
+        else // half of the last window got consumed, so refill ahead of the reader with a bigger window
+        {
+            stream.window = std::min(stream.window * 2, READAHEAD_MAX_WINDOW);
+        }
+
+        ReadaheadRequest request{std::max(stream.readahead_end, block_number + 1), stream.window};
+        stream.readahead_end = request.start_block + request.count;
+
+        return request;
+    }
+
+    for(StreamState& stream : streams) // second pass, only if no stream took the read: a re-read of a stream's last block
+    {
+        if(stream.next_block == block_number + 1) // keeps the stream alive instead of spending a fresh slot on it
+        {
+            stream.last_used = tick;
+            return {0, 0};
+        }
+    }
+
+    /*
+
+    No stream expected this block, so it's either random access or the first read of a new stream. Either way nothing gets
+    prefetched. The block gets a fresh stream with a zero window, which recycles the least recently used one when all slots
+    are taken. A stream that goes random simply stops matching and ages out.
+
+    */
+
+    StreamState fresh_stream{block_number + 1, block_number + 1, 0, tick};
+
+    if(streams.size() < READAHEAD_STREAM_COUNT)
+    {
+        streams.push_back(fresh_stream);
+    }
+
+    else
+    {
+        *std::min_element(streams.begin(), streams.end(), [](const StreamState& a, const StreamState& b)
+        {
+            return a.last_used < b.last_used;
+        }) = fresh_stream;
+    }
+
+    return {0, 0};
+}
+
+MountedDiskClass::MountedDiskClass(const std::string& disk_filename, bool read_only_mount)
+{
+    this->filename = disk_filename; // assigns the name at runtime
+    this->read_only = read_only_mount;
+
+    DiskFile = std::fstream(this->filename, read_only ? (std::ios::binary | std::ios::in) : (std::ios::binary | std::ios::out | std::ios::in));
     // opens file and caches the file access.
 
     if(!DiskFile.is_open())
@@ -33,9 +199,15 @@ MountedDiskClass::MountedDiskClass()
 
 MountedDiskClass::~MountedDiskClass()
 {   
+    if(DEBUG_FLAG){std::cout << "DEBUG: block cache hits: " << BlockCache.hits << ", misses: " << BlockCache.misses << "\n";}
+
     DiskFile.clear(); // clears the stream in case it's in an error state
-    DiskFile.seekp(0); // puts pointer to start of superblock
-    DiskFile.write(reinterpret_cast<char*>(&superblock), sizeof(superblock)); // flushes superblock to disk
+
+    if(!read_only) // nothing to flush on a read-only mount, and the file isn't open for writing anyway
+    {
+        DiskFile.seekp(0); // puts pointer to start of superblock
+        DiskFile.write(reinterpret_cast<char*>(&superblock), sizeof(superblock)); // flushes superblock to disk
+    }
 
     try
     {
@@ -45,7 +217,7 @@ MountedDiskClass::~MountedDiskClass()
             throw std::runtime_error("MountedDiskClass error: Disk flush failed. Disk close was attempted\n");
         }
 
-        if(DEBUG_FLAG){std::cout << "DEBUG: superblock flushed to disk\n";}
+        if(DEBUG_FLAG && !read_only){std::cout << "DEBUG: superblock flushed to disk\n";}
 
         DiskFile.close();
 
@@ -64,6 +236,87 @@ MountedDiskClass::~MountedDiskClass()
     }
 }
 
+void MountedDiskClass::ReadBlock(std::uint64_t block_number, Block& out_block)
+{
+    if(block_number >= BLOCK_NUMBER)
+    {
+        throw std::runtime_error("ReadBlock error: the requested block is out of bounds\n");
+    }
+
+    std::uint64_t trace_start = Tracer ? Tracer->Now() : 0;
+    std::uint8_t trace_operation = TRACE_BLOCK_READ_HIT;
+
+    ReadaheadRequest request = Readahead.OnAccess(block_number);
+
+    if(!BlockCache.Lookup(block_number, out_block))
+    {
+        trace_operation = TRACE_BLOCK_READ_MISS;
+
+        DiskFile.clear();
+        DiskFile.seekg(block_number * BLOCK_SIZE);
+        DiskFile.read(reinterpret_cast<char*>(&out_block), sizeof(out_block));
+
+        if(DiskFile.fail())
+        {
+            DiskFile.clear(); // so the destructor can still flush the superblock
+            throw std::runtime_error("ReadBlock error: disk read failed\n");
+        }
+
+        BlockCache.Insert(block_number, out_block);
+    }
+
+    if(request.count > 0)
+    {
+        Prefetch(request);
+    }
+
+    if(Tracer) // recorded after the prefetch, so the latency covers the whole call, same span the replay times
+    {
+        Tracer->Record(trace_operation, trace_start, block_number, BLOCK_SIZE);
+    }
+}
+
+void MountedDiskClass::Prefetch(const ReadaheadRequest& request)
+{
+    std::uint64_t start_block = request.start_block;
+    std::uint64_t end_block = std::min(request.start_block + request.count, BLOCK_NUMBER);
+
+    while(start_block < end_block && BlockCache.Contains(start_block)) // no point re-reading what's already cached
+    {
+        ++start_block;
+    }
+
+    if(start_block >= end_block)
+    {
+        return;
+    }
+
+    std::vector<Block> buffer(end_block - start_block); // one big read instead of one 512-byte read per block
+
+    std::uint64_t trace_start = Tracer ? Tracer->Now() : 0;
+
+    DiskFile.clear();
+    DiskFile.seekg(start_block * BLOCK_SIZE);
+    DiskFile.read(reinterpret_cast<char*>(buffer.data()), buffer.size() * BLOCK_SIZE);
+
+    std::uint64_t blocks_read = DiskFile.gcount() / BLOCK_SIZE; // a short read past the end of the file is not an error here
+
+    DiskFile.clear();
+
+    if(Tracer)
+    {
+        Tracer->Record(TRACE_BLOCK_PREFETCH, trace_start, start_block, blocks_read * BLOCK_SIZE);
+    }
+
+    for(std::uint64_t i = 0; i < blocks_read; i++)
+    {
+        if(!BlockCache.Contains(start_block + i)) // blocks past a cached one may also be cached already
+        {
+            BlockCache.Insert(start_block + i, buffer[i]);
+        }
+    }
+}
+
 std::unique_ptr<MountedDiskClass> MountedDisk;
 
 /*
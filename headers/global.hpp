@@ -13,6 +13,12 @@ thank you for your time.
 #include <fstream> // for file reading/writing
 #include <iostream> // for command line I/O streams
 #include <cstring> // for memory related functions like memset() and memcpy()
+#include <unordered_map> // for the block cache
+#include <deque> // for the block cache eviction order
+#include <algorithm> // for std::min() and std::max() in the readahead engine
+#include <chrono> // for trace timestamps and latencies
+#include <mutex> // for serializing trace record writes
+#include <atomic> // for handing out trace thread ids
 
 
 /*
@@ -45,6 +51,18 @@ constexpr std::uint32_t MAGIC = 0xFEAB1E33; // the magic number of my custom fil
 
 constexpr bool DEBUG_FLAG = true; // switch to false before creating release builds
 
+constexpr std::uint64_t BLOCK_CACHE_CAPACITY = 1024; // max blocks held in the block cache (512 KB)
+
+constexpr std::uint64_t READAHEAD_INITIAL_WINDOW = 4; // blocks prefetched once a stream is detected as sequential
+
+constexpr std::uint64_t READAHEAD_MAX_WINDOW = 128; // the window doubles on every refill up to this many blocks (64 KB)
+
+constexpr std::uint64_t READAHEAD_STREAM_COUNT = 4; // number of sequential streams tracked at the same time
+
+constexpr std::uint32_t TRACE_MAGIC = 0x53435452; // "SCTR", the magic number of workload trace files
+
+constexpr std::uint16_t TRACE_VERSION = 2; // version 2 split commands into a start and an end record
+
 /*
 
 The POD structs only depend on the cstdint header for fixed-width integers. Other then that, some depend on constants to
@@ -101,8 +119,137 @@ struct Inode // standard size 64-bytes as of now. non-padded size = 40
 
 /*
 
-MountedDiskClass depends on POD structures (SuperBlock as of now) to function, so it is declared third, after declaring
-POD structs
+Workload traces are a TraceFileHeader followed by a flat list of TraceRecords. Command start and end records are followed by
+name_length bytes of the command name, every other record has no payload. Both structs are written to disk as is, so they are packed.
+
+*/
+
+#pragma pack(push, 1)
+
+struct TraceFileHeader // size = 8 bytes
+{
+    std::uint32_t magic; // 4 bytes | offset 0
+    std::uint16_t version; // 2 bytes | offset 4
+    std::uint16_t reserved; // 2 bytes | offset 6
+};
+
+struct TraceRecord // size = 32 bytes
+{
+    std::uint64_t timestamp_ns; // 8 bytes | offset 0. Time since the trace started, taken when the operation began
+    std::uint64_t latency_ns; // 8 bytes | offset 8
+    std::uint64_t block_number; // 8 bytes | offset 16. First block touched, zero for commands
+    std::uint32_t size; // 4 bytes | offset 24. Bytes transferred, zero for commands
+    std::uint16_t name_length; // 2 bytes | offset 28. Length of the command name following the record
+    std::uint8_t operation; // 1 byte | offset 30. One of TraceOperation
+    std::uint8_t thread_id; // 1 byte | offset 31. Small per-process id of the thread that ran the operation
+};
+
+#pragma pack(pop)
+
+
+
+enum TraceOperation : std::uint8_t
+{
+    TRACE_COMMAND = 0, // a CommandInterface::CommandDispatch() call started. latency_ns is zero
+    TRACE_BLOCK_READ_HIT = 1, // demand block read served from the block cache
+    TRACE_BLOCK_READ_MISS = 2, // demand block read that went to the disk file
+    TRACE_BLOCK_PREFETCH = 3, // readahead read issued by the block layer itself
+    TRACE_COMMAND_END = 4 // the command returned, latency_ns covers the whole call. Missing if the command exited early
+};
+
+
+
+/*
+
+The tracer is opt-in. main() only creates it when the SCAF_TRACE environment variable names a trace file, so every hook
+has to check the global pointer first. It doesn't depend on the disk, so it goes before the block layer that calls it.
+
+*/
+
+
+class TraceRecorderClass
+{
+    public:
+
+        TraceRecorderClass(const std::string& trace_filename); // creates the trace file and writes the header. Throws on failure
+        ~TraceRecorderClass(); // flushes and closes the trace file
+
+        std::uint64_t Now() const; // nanoseconds since the trace started
+        void Record(std::uint8_t operation, std::uint64_t start_ns, std::uint64_t block_number, std::uint32_t size, const std::string& command_name = "");
+
+    private:
+
+        std::ofstream TraceFile;
+        std::mutex TraceMutex;
+        std::chrono::steady_clock::time_point start_time;
+        std::atomic<std::uint8_t> next_thread_id{0};
+};
+
+extern std::unique_ptr<TraceRecorderClass> Tracer; // null unless tracing was requested
+
+
+
+/*
+
+The block cache and the readahead engine make up the block layer. They only depend on the Block struct and the constants
+above, and MountedDiskClass owns one of each, so they are declared before it.
+
+*/
+
+
+class BlockCacheClass
+{
+    public:
+
+        std::uint64_t hits = 0; // reported by the MountedDiskClass destructor in debug builds
+        std::uint64_t misses = 0;
+
+        bool Lookup(std::uint64_t block_number, Block& out_block); // copies a cached block into out_block if present
+        bool Contains(std::uint64_t block_number) const;
+        void Insert(std::uint64_t block_number, const Block& in_block); // evicts the oldest block when full
+
+    private:
+
+        std::unordered_map<std::uint64_t, Block> entries;
+        std::deque<std::uint64_t> insertion_order; // oldest block at the front. Used for FIFO eviction
+};
+
+
+
+struct ReadaheadRequest // a range of blocks the readahead engine wants prefetched. count = 0 means "don't prefetch"
+{
+    std::uint64_t start_block;
+    std::uint64_t count;
+};
+
+
+
+class ReadaheadClass
+{
+    public:
+
+        ReadaheadRequest OnAccess(std::uint64_t block_number); // called on every block read, returns what to prefetch
+
+    private:
+
+        struct StreamState
+        {
+            std::uint64_t next_block; // the block this stream expects to be read next
+            std::uint64_t readahead_end; // first block past what has already been prefetched for this stream
+            std::uint64_t window; // current prefetch window in blocks. zero until the stream is known to be sequential
+            std::uint64_t last_used; // access tick, used to recycle the least recently used stream
+        };
+
+        std::vector<StreamState> streams;
+        std::uint64_t tick = 0;
+};
+
+
+
+/*
+
+MountedDiskClass depends on POD structures (SuperBlock as of now) and the block layer to function, so it is declared after
+them.
 
 */
 
@@ -115,9 +262,19 @@ class MountedDiskClass
         SuperBlock superblock;                           
         std::vector<std::uint8_t> bitmap;
         std::fstream DiskFile;                  
+        bool read_only; // read-only mounts open the file without write access and never flush the superblock
 
-        MountedDiskClass(); // the constructor is responsible for mounting the disk
+        MountedDiskClass(const std::string& disk_filename = "floppy.disk", bool read_only_mount = false); // mounts the disk
         ~MountedDiskClass(); // the destructor is responsible for dismounting the disk
+
+        void ReadBlock(std::uint64_t block_number, Block& out_block); // cached block read. Throws on failure
+
+    private:
+
+        BlockCacheClass BlockCache;
+        ReadaheadClass Readahead;
+
+        void Prefetch(const ReadaheadRequest& request); // reads the whole range in one go and fills the cache
 };
 
 
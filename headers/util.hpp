@@ -4,6 +4,11 @@
 /*                    // any STL headers declared here are unique to the utilities.
 */
 
+#include <map> // for grouping trace records by thread in ReplayTrace()
+#include <thread> // for replaying a trace at its original concurrency
+#include <exception> // for handing exceptions from replay threads back to the caller
+#include <cmath> // for std::ceil() in PrintLatencyDistribution()
+
 
 
 
@@ -39,4 +44,12 @@ void DumpSpecificBlock(const std::vector<std::string>& args); // parses a ".disk
 
 std::uint64_t AllocateBlock(); // will probably move over to become a method to MountedDiskClass();
 
-void TestMount(); // prints a message and nothing else.
\ No newline at end of file
+void TestMount(); // prints a message and nothing else.
+
+
+
+void PrintLatencyDistribution(const std::string& label, std::vector<std::uint64_t> latencies_ns); // prints count, min,
+/*                                                                                                  // percentiles and max
+*/
+
+void ReplayTrace(const std::vector<std::string>& args); // re-executes the block reads of a trace against an image
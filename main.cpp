@@ -2,6 +2,7 @@
 #include <vector> // for CommandInterface class
 #include <unordered_map> // for CommandInterfaceClass
 #include <functional> // for CommandInterfaceClass
+#include <cstdlib> // for std::getenv()
 #include "headers/global.hpp" // global constants, structures, classes and objects
 #include "headers/util.hpp" // miscellaenous functions not associated with a class
 
@@ -43,13 +44,26 @@ class CommandInterface
             DispatchTable["dump"] = [](std::vector<std::string> args){DumpSpecificBlock(args);};
             DispatchTable["test-allocate"] = [](std::vector<std::string> args){AllocateBlock();};
             DispatchTable["test-mount"] = [](std::vector<std::string> args){TestMount();};
+            DispatchTable["replay"] = [](std::vector<std::string> args){ReplayTrace(args);};
         }
 
         void CommandDispatch(const std::vector<std::string>& args)
         {
             if(DispatchTable.find(args[1]) != DispatchTable.end()) // 4: checks if command exists or not. If yes, calls function with args
             {
+                std::uint64_t trace_start = Tracer ? Tracer->Now() : 0;
+
+                if(Tracer) // written up front, because most handlers std::exit() on failure and never come back here
+                {
+                    Tracer->Record(TRACE_COMMAND, trace_start, 0, 0, args[1]);
+                }
+
                 DispatchTable[args[1]](args);
+
+                if(Tracer)
+                {
+                    Tracer->Record(TRACE_COMMAND_END, trace_start, 0, 0, args[1]);
+                }
             }
 
             else
@@ -69,10 +83,18 @@ int main(int argc, char* argv[])
 
     try
     {
-        MountedDisk = std::make_unique<MountedDiskClass>(); // mounts the disk.
+        if(args.size() < 2 || args[1] != "replay") // replay mounts the image it's given instead
+        {
+            MountedDisk = std::make_unique<MountedDiskClass>(); // mounts the disk.
+
+            if(const char* trace_filename = std::getenv("SCAF_TRACE")) // tracing is opt-in
+            {
+                Tracer = std::make_unique<TraceRecorderClass>(trace_filename);
+            }
+        }
     }
 
-    catch(std::exception& e) // in the event of mount errors.
+    catch(std::exception& e) // in the event of mount or trace file errors.
     {
         std::cerr << e.what();
         MountedDisk.reset(); // dismounts the disk
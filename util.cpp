@@ -38,29 +38,38 @@ void DumpSpecificBlock(const std::vector<std::string>& args)
         }
 
         int block_number(std::stoi(args[2])); // converts argument block number to integer
+        int last_block_number = (args.size() > 3) ? std::stoi(args[3]) : block_number; // optional end of an inclusive range
 
-        std::string DumpFilename = "block_" + std::to_string(block_number) + ".dump";
-
-        std::fstream Disk(MountedDisk->filename, std::ios::binary | std::ios::in);
-
-        Block dump_block;
-
-        if(!Disk.is_open())
+        if(block_number < 0 || last_block_number < block_number || static_cast<std::uint64_t>(last_block_number) >= BLOCK_NUMBER)
         {
-            std::cerr << "DumpSpecificBlock error: could not open disk for reading\n";
+            std::cerr << "DumpSpecificBLock error: the requested block is out of bounds\n";
             std::exit(1);
         }
 
-        if(block_number * BLOCK_SIZE > BLOCK_SIZE * BLOCK_NUMBER)
+        std::string DumpFilename = "block_" + std::to_string(block_number) + ".dump";
+
+        if(last_block_number != block_number)
         {
-            std::cerr << "DumpSpecificBLock error: the requested block is out of bounds\n";
-            std::exit(1);
+            DumpFilename = "block_" + std::to_string(block_number) + "-" + std::to_string(last_block_number) + ".dump";
         }
 
-        Disk.seekg(block_number * BLOCK_SIZE); // note to self: seekp is for output. seekg is for input
-        Disk.read(reinterpret_cast<char*>(&dump_block), sizeof(dump_block));
+        /*
+
+        Blocks are read in order through the mounted disk, so after the first couple of reads the readahead engine picks up
+        the sequential stream and the rest of the range comes out of the block cache.
+
+        */
+
+        std::vector<std::uint8_t> BufferToDump;
+        Block dump_block;
+
+        for(int i = block_number; i <= last_block_number; i++)
+        {
+            MountedDisk->ReadBlock(i, dump_block);
+            BufferToDump.insert(BufferToDump.end(), dump_block.data, dump_block.data + BLOCK_SIZE);
+        }
 
-        DumpStruct(DumpFilename, dump_block);
+        DumpTunnel(DumpFilename, BufferToDump);
     }
 
     catch(std::invalid_argument &e)
@@ -83,17 +92,7 @@ void DumpSpecificBlock(const std::vector<std::string>& args)
 
 std::uint64_t AllocateBlock()
 {
-    std::fstream Disk(MountedDisk->filename, std::ios::binary | std::ios::in | std::ios::out);
-
-    if(!Disk.is_open())
-    {
-        std::cerr << "AllocateBlock error: Disk could not be opened\n";
-        std::exit(1);
-    }
-
-    SuperBlock superblock;
-
-    Disk.read(reinterpret_cast<char*>(&superblock), sizeof(superblock));
+    const SuperBlock& superblock = MountedDisk->superblock;
 
     std::uint8_t bitmap[BLOCK_SIZE * superblock.block_bitmap_block_count]; // computes amount of bytes in the entire bitmap
 
@@ -101,17 +100,14 @@ std::uint64_t AllocateBlock()
 
     for (size_t i = 0; i < superblock.block_bitmap_block_count; i++) // goes through each individual bitmap block according to superblock
     {
-        Disk.seekg((superblock.block_bitmap_block_start + i) * BLOCK_SIZE);
-        
+        MountedDisk->ReadBlock(superblock.block_bitmap_block_start + i, bitmap_block);
+
         /*
-        
-        computes the offset of individual bitmap blocks and puts the reading pointer to the correct position.
-        If it's the first iteration, then the offset would be the same as the start of the block bitmap region
-        aka the offset of the first bitmap block       
-        
-        */
 
-        Disk.read(reinterpret_cast<char*>(&bitmap_block), sizeof(bitmap_block)); // reads the bitmap block into the buffer
+        reads the bitmap block into the buffer. If it's the first iteration, then the block is the same as the start of the
+        block bitmap region. The bitmap blocks are contiguous, so the readahead engine prefetches the rest after the second read
+
+        */
 
         std::memcpy(&bitmap[i * BLOCK_SIZE], &bitmap_block, sizeof(bitmap_block));
         
@@ -153,11 +149,226 @@ std::uint64_t AllocateBlock()
         }
     }
 
-    Disk.close();
     return -1;
 }
 
 void TestMount()
 {
     std::cout << "program executed\n\n\n";
-}
\ No newline at end of file
+}
+
+
+
+void PrintLatencyDistribution(const std::string& label, std::vector<std::uint64_t> latencies_ns)
+{
+    if(latencies_ns.empty())
+    {
+        std::cout << label << ": no operations\n";
+        return;
+    }
+
+    std::sort(latencies_ns.begin(), latencies_ns.end());
+
+    auto percentile = [&latencies_ns](double p) // nearest-rank percentile, converted to microseconds
+    {
+        std::size_t rank = static_cast<std::size_t>(std::ceil(p * latencies_ns.size())); // 1-based, rank 0 only for p = 0
+        return latencies_ns[std::max<std::size_t>(rank, 1) - 1] / 1000.0;
+    };
+
+    std::cout << label << " latency (us) over " << latencies_ns.size() << " ops: min " << percentile(0.0)
+              << ", p50 " << percentile(0.50) << ", p90 " << percentile(0.90) << ", p99 " << percentile(0.99)
+              << ", max " << percentile(1.0) << "\n";
+}
+
+
+
+void ReplayTrace(const std::vector<std::string>& args)
+{
+    try
+    {
+        if(args.size() <= 3)
+        {
+            std::cerr << "ReplayTrace error: too few arguments\n";
+            std::exit(1);
+        }
+
+        bool original_concurrency = false;
+
+        if(args.size() > 4)
+        {
+            if(args[4] == "original")
+            {
+                original_concurrency = true;
+            }
+
+            else if(args[4] != "single")
+            {
+                std::cerr << "ReplayTrace error: concurrency must be either \"single\" or \"original\"\n";
+                std::exit(1);
+            }
+        }
+
+        std::ifstream TraceFile(args[2], std::ios::binary);
+
+        if(!TraceFile.is_open())
+        {
+            std::cerr << "ReplayTrace error: could not open trace file\n";
+            std::exit(1);
+        }
+
+        TraceFileHeader header{};
+        TraceFile.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+        if(TraceFile.fail() || header.magic != TRACE_MAGIC || header.version != TRACE_VERSION)
+        {
+            std::cerr << "ReplayTrace error: not a trace file, or one written by a different version\n";
+            std::exit(1);
+        }
+
+        /*
+
+        Only demand reads get re-executed. Prefetches are a side effect of those reads, so the block layer being benchmarked
+        issues its own, and commands are only counted because re-running something like "init" would wipe the image.
+
+        */
+
+        std::map<std::uint8_t, std::vector<std::uint64_t>> blocks_by_thread; // demand reads, in order, per original thread
+        std::vector<std::uint64_t> captured_latencies;
+        std::uint64_t command_count = 0;
+        std::uint64_t finished_command_count = 0;
+        std::uint64_t prefetch_count = 0;
+
+        TraceRecord record;
+
+        while(TraceFile.read(reinterpret_cast<char*>(&record), sizeof(record)))
+        {
+            TraceFile.seekg(record.name_length, std::ios::cur); // skips the command name, if any
+
+            if(record.operation == TRACE_COMMAND)
+            {
+                ++command_count;
+            }
+
+            else if(record.operation == TRACE_COMMAND_END)
+            {
+                ++finished_command_count;
+            }
+
+            else if(record.operation == TRACE_BLOCK_PREFETCH)
+            {
+                ++prefetch_count;
+            }
+
+            else
+            {
+                blocks_by_thread[original_concurrency ? record.thread_id : 0].push_back(record.block_number); // scaf only
+                                                                                                              // ever traces
+                                                                                                              // thread 0 today
+                captured_latencies.push_back(record.latency_ns);
+            }
+        }
+
+        std::cout << "trace: " << command_count << " commands (" << command_count - finished_command_count << " exited early), " << captured_latencies.size() << " block reads, "
+                  << prefetch_count << " prefetches\n";
+
+        /*
+
+        Every replay thread gets its own private mount, so nothing in the block layer is shared between threads. That is NOT
+        what a traced process does, where all threads would share the one global MountedDisk, its cache and its readahead
+        streams. So "original" mode measures independent caches, not the original contention. At least one mount is always
+        made up front, even for a trace with no block reads, so a bad image fails the same way every time. The mounts are
+        read-only, so a benchmark never needs write access to the image and never modifies it.
+
+        */
+
+        std::size_t mount_count = std::max<std::size_t>(blocks_by_thread.size(), 1);
+
+        std::vector<std::unique_ptr<MountedDiskClass>> Mounts;
+        std::vector<std::vector<std::uint64_t>> replay_latencies(mount_count);
+        std::vector<std::exception_ptr> replay_errors(mount_count);
+
+        for(std::size_t i = 0; i < mount_count; i++)
+        {
+            Mounts.push_back(std::make_unique<MountedDiskClass>(args[3], true));
+        }
+
+        auto ReplayStream = [](MountedDiskClass& Disk, const std::vector<std::uint64_t>& blocks, std::vector<std::uint64_t>& latencies, std::exception_ptr& error)
+        {
+            try // an exception must not escape a replay thread, so it's handed back to the caller instead
+            {
+                Block replay_block;
+
+                for(std::uint64_t block_number : blocks)
+                {
+                    auto start = std::chrono::steady_clock::now();
+                    Disk.ReadBlock(block_number, replay_block);
+                    latencies.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+                }
+            }
+
+            catch(...)
+            {
+                error = std::current_exception();
+            }
+        };
+
+        auto replay_start = std::chrono::steady_clock::now();
+
+        if(original_concurrency)
+        {
+            std::vector<std::thread> ReplayThreads;
+            std::size_t index = 0;
+
+            for(const auto& [thread_id, blocks] : blocks_by_thread)
+            {
+                ReplayThreads.emplace_back(ReplayStream, std::ref(*Mounts[index]), std::cref(blocks), std::ref(replay_latencies[index]), std::ref(replay_errors[index]));
+                ++index;
+            }
+
+            for(std::thread& ReplayThread : ReplayThreads)
+            {
+                ReplayThread.join();
+            }
+        }
+
+        else if(!blocks_by_thread.empty())
+        {
+            ReplayStream(*Mounts[0], blocks_by_thread[0], replay_latencies[0], replay_errors[0]);
+        }
+
+        for(const std::exception_ptr& error : replay_errors) // both modes report the first failure the same way
+        {
+            if(error)
+            {
+                std::rethrow_exception(error);
+            }
+        }
+
+        double elapsed_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - replay_start).count();
+
+        std::vector<std::uint64_t> all_replay_latencies;
+
+        for(const std::vector<std::uint64_t>& latencies : replay_latencies)
+        {
+            all_replay_latencies.insert(all_replay_latencies.end(), latencies.begin(), latencies.end());
+        }
+
+        std::cout << "replayed " << all_replay_latencies.size() << " block reads on " << blocks_by_thread.size()
+                  << " thread(s) in " << elapsed_seconds << " s\n";
+
+        if(elapsed_seconds > 0)
+        {
+            std::cout << "throughput: " << all_replay_latencies.size() / elapsed_seconds << " ops/s, "
+                      << all_replay_latencies.size() * BLOCK_SIZE / elapsed_seconds / (1024 * 1024) << " MB/s\n";
+        }
+
+        PrintLatencyDistribution("captured", captured_latencies);
+        PrintLatencyDistribution("replayed", all_replay_latencies);
+    }
+
+    catch(std::exception &e) // mount errors and failed block reads
+    {
+        std::cerr << e.what();
+        std::exit(1);
+    }
+}